@@ -1,4 +1,5 @@
 #include "audio-capture.h"
+#include "zoom-processing.h"
 #include <iostream>
 #include <mmdeviceapi.h>
 #include <audioclient.h>
@@ -17,7 +18,7 @@ const IID IID_IAudioClient = __uuidof(IAudioClient);
 const IID IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
 
 // Función principal del hilo de captura de audio (WASAPI)
-void AudioCaptureThread(AudioData& sharedData, VisualizerData& visualizerData) {
+void AudioCaptureThread(AudioData& sharedData, VisualizerData& visualizerData, ZoomData& zoomData) {
     HRESULT hr = S_OK;
     IMMDeviceEnumerator* pEnumerator = NULL;
     IMMDevice* pDevice = NULL;
@@ -132,9 +133,17 @@ void AudioCaptureThread(AudioData& sharedData, VisualizerData& visualizerData) {
         if (buffer_position >= FFT_SIZE) {
             std::unique_lock<std::mutex> lock(sharedData.mtx);
             std::copy(local_buffer.begin(), local_buffer.begin() + FFT_SIZE, sharedData.in_data.begin());
+            ++sharedData.sequence;
+            sharedData.publish_time = std::chrono::steady_clock::now();
             lock.unlock();
 
             sharedData.cv.notify_one();
+
+            // Alimentar el historial del modo zoom aquí, donde cada bloque se publica exactamente una vez,
+            // y fuera del mutex del búfer de captura para no retrasar al hilo de procesamiento.
+            if (zoomData.active.load()) {
+                AppendZoomSamples(zoomData, local_buffer);
+            }
             buffer_position = 0;
         }
     }
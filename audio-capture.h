@@ -4,4 +4,5 @@
 
 // Prototypes of the functions in audio-capture.cpp
 // This is the declaration that the compiler needs to find when compiling main.cpp.
-void AudioCaptureThread(AudioData& sharedData, VisualizerData& visualizerData);
+// Each captured block is also appended to the zoom history when the zoom mode is active.
+void AudioCaptureThread(AudioData& sharedData, VisualizerData& visualizerData, ZoomData& zoomData);
@@ -4,10 +4,64 @@
 #include <fftw3.h>
 #include <cmath>
 #include <numeric>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
 
-// Frecuencia de muestreo (Sample rate) del audio.
-// Este valor es crucial para el cálculo de la resolución de la FFT.
-const double SAMPLE_RATE = 44100.0;
+// Mutex del planificador de FFTW, compartido con el hilo de zoom.
+std::mutex fftw_planner_mtx;
+
+// Paso de cuantización (dB) de los fotogramas grabados con diferencias. Es más grueso que el de la
+// visualización para que el ruido de fondo del espectro no genere diferencias en cada barra.
+const double RECORD_QUANTIZATION_STEP = 0.5;
+
+// Devuelve un nombre de archivo que no exista, añadiendo un número antes de la extensión
+// ("grabacion.bin" -> "grabacion-1.bin"), para no sobrescribir grabaciones anteriores.
+static std::string MakeUniqueRecordFileName(const std::string& file_name) {
+    if (!std::ifstream(file_name)) {
+        return file_name;
+    }
+    size_t dot = file_name.find_last_of('.');
+    size_t separator = file_name.find_last_of("/\\");
+    if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) {
+        dot = file_name.size();
+    }
+    for (int i = 1; ; ++i) {
+        std::string candidate = file_name.substr(0, dot) + "-" + std::to_string(i) + file_name.substr(dot);
+        if (!std::ifstream(candidate)) {
+            return candidate;
+        }
+    }
+}
+
+// Aproximación de la magnitud de un número complejo sin raíz cuadrada
+// ("alpha max plus beta min", error máximo de aproximadamente un 4%).
+// Se usa cuando el planificador pide un procesamiento más barato.
+static inline double FastMagnitude(double re, double im) {
+    double a = std::fabs(re);
+    double b = std::fabs(im);
+    double max_val = std::max(a, b);
+    double min_val = std::min(a, b);
+    return 0.960433870103 * max_val + 0.397824734759 * min_val;
+}
+
+// Aproximación de 10 * log10(1 + x) a partir de los bits del float: el exponente da la parte
+// entera del log2 y un polinomio de segundo grado aproxima la mantisa (error < 0.02 dB).
+// Se usa en lugar de log10 cuando el planificador pide un procesamiento más barato.
+static inline double FastDecibels(double x) {
+    float value = static_cast<float>(1.0 + x);
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 128;
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(mantissa));
+    float log2_value = exponent + (-0.34484843f * mantissa + 2.02466578f) * mantissa - 0.67487759f;
+    // El polinomio devuelve log2(mantisa) + 1, de ahí el sesgo de 128 en el exponente. 10 * log10(2) = 3.0103
+    return 3.01029995664 * log2_value;
+}
 
 // Función principal del hilo de procesamiento de audio
 void AudioProcessingThread(AudioData& sharedData, VisualizerData& sharedVisualizerData, SharedConfigData& sharedConfigData) {
@@ -20,21 +74,94 @@ void AudioProcessingThread(AudioData& sharedData, VisualizerData& sharedVisualiz
         return;
     }
 
-    std::vector<double> dummy_in(FFT_SIZE);
-    plan_forward = fftw_plan_dft_r2c_1d(FFT_SIZE, dummy_in.data(), fft_out, FFTW_MEASURE);
+    // Búfer local de entrada de la FFT, para no mantener bloqueado el búfer de captura
+    // durante la transformación.
+    std::vector<double> fft_in(FFT_SIZE);
+    std::unique_lock<std::mutex> planner_lock(fftw_planner_mtx);
+    plan_forward = fftw_plan_dft_r2c_1d(FFT_SIZE, fft_in.data(), fft_out, FFTW_MEASURE);
+    planner_lock.unlock();
+
+    // Periodo de un bloque de audio: el tiempo disponible para procesarlo antes de que llegue el siguiente.
+    const double block_period = FFT_SIZE / SAMPLE_RATE;
+    // Último bloque visto y último bloque procesado, por número de secuencia.
+    uint64_t last_seen_sequence = 0;
+    uint64_t last_processed_sequence = 0;
+
+    // Valores de las barras antes de empaquetarlos. Se reutiliza entre bloques.
+    std::vector<double> bar_values;
+
+    // Grabación opcional de los fotogramas empaquetados.
+    std::unique_lock<std::mutex> record_config_lock(sharedConfigData.mtx);
+    const std::string record_file = sharedConfigData.config.record_file;
+    const bool record_delta_encoding = sharedConfigData.config.record_delta_encoding;
+    record_config_lock.unlock();
+
+    std::ofstream record_stream;
+    std::string record_path;
+    if (!record_file.empty()) {
+        record_path = MakeUniqueRecordFileName(record_file);
+        record_stream.open(record_path, std::ios::binary);
+        if (!record_stream.is_open()) {
+            std::cerr << "Error: No se pudo abrir el archivo de grabación: " << record_path << std::endl;
+        }
+        else {
+            WriteBarFrameFileHeader(record_stream);
+            std::cout << "Grabando fotogramas en " << record_path;
+            // Las diferencias necesitan una escala fija entre fotogramas: se graba una copia de 8 bits
+            // con el paso grueso, independiente del formato que recibe el renderizador.
+            if (record_delta_encoding) {
+                std::cout << " (diferencias sobre códigos de 8 bits, paso de " << RECORD_QUANTIZATION_STEP << " dB)";
+            }
+            std::cout << "." << std::endl;
+        }
+    }
+    std::vector<uint8_t> record_buffer;
+    PackedBarFrame record_frame;
+    PackedBarFrame previous_recorded_frame;
+    bool has_previous_recorded_frame = false;
 
     while (!sharedVisualizerData.should_terminate.load()) {
         std::unique_lock<std::mutex> lock(sharedData.mtx);
-        sharedData.cv.wait(lock);
+        // Esperar a un bloque con un número de secuencia nuevo; así se ignoran los despertares espurios.
+        sharedData.cv.wait(lock, [&] {
+            return sharedData.sequence != last_seen_sequence || sharedVisualizerData.should_terminate.load();
+        });
 
         if (sharedVisualizerData.should_terminate.load()) {
             break;
         }
 
-        fftw_execute_dft_r2c(plan_forward, sharedData.in_data.data(), fft_out);
+        // Los números de secuencia saltados son bloques que la captura sobrescribió antes de que este
+        // hilo los leyera: plazos incumplidos. El primer bloque no cuenta, el hilo acaba de empezar.
+        uint64_t sequence = sharedData.sequence;
+        if (last_seen_sequence != 0 && sequence > last_seen_sequence + 1) {
+            ReportMissedBlocks(sharedVisualizerData.scheduler, sequence - last_seen_sequence - 1);
+        }
+        last_seen_sequence = sequence;
+
+        // Leer el nivel de calidad que ha fijado el planificador para este bloque.
+        int quality_level = sharedVisualizerData.scheduler.quality_level.load();
+        int hop_multiplier = GetHopMultiplier(quality_level);
+        int bar_step = GetBarStep(quality_level);
+        bool cheap_dsp = UseCheapDsp(quality_level);
+
+        // Con un salto mayor se descartan bloques intermedios, contados por número de secuencia.
+        if (last_processed_sequence != 0 && sequence - last_processed_sequence < static_cast<uint64_t>(hop_multiplier)) {
+            continue;
+        }
+        last_processed_sequence = sequence;
+
+        // El retraso se mide desde que la captura publicó el bloque, para incluir el tiempo que
+        // este hilo tardó en despertar si la CPU estaba ocupada.
+        auto block_publish_time = sharedData.publish_time;
+
+        // Copiar el bloque de audio para no mantener bloqueado el búfer de captura durante la FFT.
+        std::copy(sharedData.in_data.begin(), sharedData.in_data.end(), fft_in.begin());
 
         lock.unlock();
 
+        fftw_execute_dft_r2c(plan_forward, fft_in.data(), fft_out);
+
         int write_index = sharedVisualizerData.write_buffer_index.load();
 
         // Obtener el número de barras de la variable atómica para el procesamiento.
@@ -43,22 +170,27 @@ void AudioProcessingThread(AudioData& sharedData, VisualizerData& sharedVisualiz
         // Obtener el factor de agrupamiento de la configuración.
         std::unique_lock<std::mutex> config_lock(sharedConfigData.mtx);
         float bin_grouping_factor = sharedConfigData.config.bin_grouping_factor;
+        int bar_frame_bits = sharedConfigData.config.bar_frame_bits;
         config_lock.unlock();
 
         // Calcular la resolución de frecuencia por bin de la FFT.
         const double bin_resolution = SAMPLE_RATE / FFT_SIZE;
         const double bins_per_bar = bin_grouping_factor / bin_resolution;
 
+        // Con menos barras, cada barra calculada cubre 'bar_step' columnas y el fotograma
+        // solo lleva una barra por grupo, así que empaquetado y renderizado también se reducen.
+        int num_groups = (num_bars + bar_step - 1) / bar_step;
+
         // Limpiar el búfer antes de escribir en él
-        sharedVisualizerData.out_data[write_index].resize(num_bars, 0.0);
-        std::fill(sharedVisualizerData.out_data[write_index].begin(), sharedVisualizerData.out_data[write_index].end(), 0.0);
+        bar_values.assign(num_groups, 0.0);
 
-        for (int i = 0; i < num_bars; ++i) {
+        for (int i = 0; i < num_bars; i += bar_step) {
             double total_magnitude = 0.0;
+            int group_end = std::min(i + bar_step, num_bars);
 
             // Determinar los índices de los bins de la FFT a agrupar.
             int start_bin = static_cast<int>(i * bins_per_bar);
-            int end_bin = static_cast<int>((i + 1) * bins_per_bar);
+            int end_bin = static_cast<int>(group_end * bins_per_bar);
 
             // Asegurarse de no exceder los límites del array de la FFT.
             if (end_bin > FFT_SIZE / 2) {
@@ -66,24 +198,82 @@ void AudioProcessingThread(AudioData& sharedData, VisualizerData& sharedVisualiz
             }
 
             // Sumar las magnitudes de los bins de la FFT correspondientes a esta barra.
-            for (int j = start_bin; j < end_bin; ++j) {
-                total_magnitude += sqrt(fft_out[j][0] * fft_out[j][0] + fft_out[j][1] * fft_out[j][1]);
+            if (cheap_dsp) {
+                for (int j = start_bin; j < end_bin; ++j) {
+                    total_magnitude += FastMagnitude(fft_out[j][0], fft_out[j][1]);
+                }
             }
+            else {
+                for (int j = start_bin; j < end_bin; ++j) {
+                    total_magnitude += sqrt(fft_out[j][0] * fft_out[j][0] + fft_out[j][1] * fft_out[j][1]);
+                }
+            }
+
+            // Promediar sobre las columnas del grupo para mantener la escala de una sola barra.
+            total_magnitude /= (group_end - i);
 
             // Aplicar la escala logarítmica y otros factores.
-            double scaled_value = 10.0 * log10(1 + total_magnitude);
-            scaled_value = std::min(scaled_value, 50.0);
+            double scaled_value = cheap_dsp ? FastDecibels(total_magnitude) : 10.0 * log10(1 + total_magnitude);
+            scaled_value = std::min(scaled_value, MAX_BAR_VALUE);
             scaled_value = std::max(scaled_value, 0.0);
 
-            if (i < sharedVisualizerData.out_data[write_index].size()) {
-                sharedVisualizerData.out_data[write_index][i] = scaled_value;
-            }
+            bar_values[i / bar_step] = scaled_value;
         }
 
+        // Empaquetar las barras en el fotograma cuantizado que lee el renderizador. El mutex protege
+        // el fotograma mientras se redimensiona, ya que el renderizador lo copia bajo el mismo mutex.
+        std::unique_lock<std::mutex> frame_lock(sharedVisualizerData.mtx);
+        PackedBarFrame& frame = sharedVisualizerData.out_frames[write_index];
+        PackBarFrame(bar_values.data(), num_groups, bar_frame_bits, frame);
+        frame.header.columns_per_bar = static_cast<uint16_t>(bar_step);
         sharedVisualizerData.write_buffer_index.store(1 - write_index);
+        frame_lock.unlock();
+
         sharedVisualizerData.cv.notify_one();
+
+        // Informar al planificador del retraso del bloque frente al periodo de los bloques procesados.
+        // Se mide antes de grabar para que la escritura en disco no cuente como carga de procesamiento.
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - block_publish_time;
+        ReportProcessingTime(sharedVisualizerData.scheduler, elapsed.count(), block_period * hop_multiplier);
+
+        // Grabar el fotograma publicado. Solo este hilo escribe en él, y no lo hará hasta el siguiente bloque.
+        if (record_stream.is_open()) {
+            const PackedBarFrame* recorded = &frame;
+            const PackedBarFrame* previous = nullptr;
+            if (record_delta_encoding) {
+                PackBarFrameRange(bar_values.data(), num_groups, 8, 0.0, RECORD_QUANTIZATION_STEP * 255, record_frame);
+                record_frame.header.columns_per_bar = static_cast<uint16_t>(bar_step);
+                recorded = &record_frame;
+                if (has_previous_recorded_frame) {
+                    if (previous_recorded_frame.header.num_bars == record_frame.header.num_bars) {
+                        previous = &previous_recorded_frame;
+                    }
+                    else {
+                        std::cout << "Grabación: fotograma completo sin diferencias, el número de barras cambió de "
+                            << previous_recorded_frame.header.num_bars << " a " << record_frame.header.num_bars << "." << std::endl;
+                    }
+                }
+            }
+
+            WriteBarFrameRecord(record_stream, *recorded, previous, record_buffer);
+            if (!record_stream) {
+                std::cerr << "Error: No se pudo escribir en el archivo de grabación: " << record_path << std::endl;
+                record_stream.close();
+            }
+            else {
+                // Cada registro lleva delante su tamaño (uint32_t).
+                sharedVisualizerData.recorded_bytes.fetch_add(sizeof(uint32_t) + record_buffer.size());
+                sharedVisualizerData.recorded_raw_bytes.fetch_add(sizeof(uint32_t) + sizeof(BarFrameHeader) + recorded->payload.size());
+                if (record_delta_encoding) {
+                    std::swap(previous_recorded_frame, record_frame);
+                    has_previous_recorded_frame = true;
+                }
+            }
+        }
     }
 
+    planner_lock.lock();
     fftw_destroy_plan(plan_forward);
+    planner_lock.unlock();
     fftw_free(fft_out);
 }
@@ -0,0 +1,396 @@
+#include "bar-frame.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// SSE2 está disponible en todos los procesadores x64.
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BAR_FRAME_USE_SSE2 1
+#endif
+
+// Busca el valor mínimo y máximo de las barras.
+static void FindRange(const double* values, int num_bars, double& min_value, double& max_value) {
+    min_value = num_bars > 0 ? values[0] : 0.0;
+    max_value = min_value;
+    int i = 0;
+#ifdef BAR_FRAME_USE_SSE2
+    if (num_bars >= 2) {
+        __m128d min_vec = _mm_set1_pd(min_value);
+        __m128d max_vec = min_vec;
+        for (; i + 2 <= num_bars; i += 2) {
+            __m128d v = _mm_loadu_pd(values + i);
+            min_vec = _mm_min_pd(min_vec, v);
+            max_vec = _mm_max_pd(max_vec, v);
+        }
+        double min_lanes[2], max_lanes[2];
+        _mm_storeu_pd(min_lanes, min_vec);
+        _mm_storeu_pd(max_lanes, max_vec);
+        min_value = std::min(min_lanes[0], min_lanes[1]);
+        max_value = std::max(max_lanes[0], max_lanes[1]);
+    }
+#endif
+    for (; i < num_bars; ++i) {
+        min_value = std::min(min_value, values[i]);
+        max_value = std::max(max_value, values[i]);
+    }
+}
+
+// Cuantiza un valor con el mismo redondeo (al par más cercano) que usa SSE2.
+static inline unsigned int QuantizeValue(double value, double offset, double inv_scale, double max_code) {
+    double q = (value - offset) * inv_scale;
+    q = std::min(std::max(q, 0.0), max_code);
+    return static_cast<unsigned int>(std::nearbyint(q));
+}
+
+#ifdef BAR_FRAME_USE_SSE2
+// Cuantiza cuatro valores y devuelve cuatro enteros de 32 bits ya limitados a [0, max_code].
+static inline __m128i Quantize4(const double* values, __m128d offset, __m128d inv_scale, __m128d zero, __m128d max_code) {
+    __m128d a = _mm_loadu_pd(values);
+    __m128d b = _mm_loadu_pd(values + 2);
+    a = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_sub_pd(a, offset), inv_scale), zero), max_code);
+    b = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_sub_pd(b, offset), inv_scale), zero), max_code);
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(a), _mm_cvtpd_epi32(b));
+}
+#endif
+
+void PackBarFrame(const double* values, int num_bars, int bits, PackedBarFrame& frame) {
+    double min_value, max_value;
+    FindRange(values, std::max(num_bars, 0), min_value, max_value);
+    PackBarFrameRange(values, num_bars, bits, min_value, max_value, frame);
+}
+
+void PackBarFrameRange(const double* values, int num_bars, int bits, double min_value, double max_value, PackedBarFrame& frame) {
+    if (num_bars < 0) {
+        num_bars = 0;
+    }
+    bits = (bits == 8) ? 8 : 16;
+    const int max_code = (bits == 8) ? 255 : 65535;
+
+    // La cabecera guarda floats; se cuantiza con esos mismos valores para que la reconstrucción coincida.
+    frame.header.num_bars = static_cast<uint32_t>(num_bars);
+    frame.header.bits = static_cast<uint8_t>(bits);
+    frame.header.flags = 0;
+    frame.header.columns_per_bar = 1;
+    frame.header.offset = static_cast<float>(min_value);
+    frame.header.scale = static_cast<float>((max_value - min_value) / max_code);
+
+    const double offset = frame.header.offset;
+    const double inv_scale = frame.header.scale > 0.0f ? 1.0 / frame.header.scale : 0.0;
+
+    frame.payload.resize(static_cast<size_t>(num_bars) * (bits / 8));
+    int i = 0;
+
+    if (bits == 8) {
+        uint8_t* codes = frame.payload.data();
+#ifdef BAR_FRAME_USE_SSE2
+        const __m128d offset_vec = _mm_set1_pd(offset);
+        const __m128d inv_scale_vec = _mm_set1_pd(inv_scale);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d max_code_vec = _mm_set1_pd(max_code);
+        for (; i + 8 <= num_bars; i += 8) {
+            __m128i lo = Quantize4(values + i, offset_vec, inv_scale_vec, zero, max_code_vec);
+            __m128i hi = Quantize4(values + i + 4, offset_vec, inv_scale_vec, zero, max_code_vec);
+            // 32 -> 16 bits con saturación y 16 -> 8 bits sin signo.
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(codes + i), packed);
+        }
+#endif
+        for (; i < num_bars; ++i) {
+            codes[i] = static_cast<uint8_t>(QuantizeValue(values[i], offset, inv_scale, max_code));
+        }
+    }
+    else {
+        // Los códigos de 16 bits se escriben byte a byte (SSE2 o memcpy), sin reinterpretar el vector de bytes.
+        uint8_t* codes = frame.payload.data();
+#ifdef BAR_FRAME_USE_SSE2
+        const __m128d offset_vec = _mm_set1_pd(offset);
+        const __m128d inv_scale_vec = _mm_set1_pd(inv_scale);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d max_code_vec = _mm_set1_pd(max_code);
+        const __m128i bias32 = _mm_set1_epi32(32768);
+        const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+        for (; i + 8 <= num_bars; i += 8) {
+            __m128i lo = Quantize4(values + i, offset_vec, inv_scale_vec, zero, max_code_vec);
+            __m128i hi = Quantize4(values + i + 4, offset_vec, inv_scale_vec, zero, max_code_vec);
+            // SSE2 solo empaqueta con signo: se desplaza el rango a [-32768, 32767] y se restaura después.
+            __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + 2 * i), _mm_xor_si128(packed, bias16));
+        }
+#endif
+        for (; i < num_bars; ++i) {
+            uint16_t code = static_cast<uint16_t>(QuantizeValue(values[i], offset, inv_scale, max_code));
+            std::memcpy(codes + 2 * i, &code, sizeof(code));
+        }
+    }
+}
+
+// Código de la barra 'i', independientemente del número de bits.
+static inline int GetBarCode(const PackedBarFrame& frame, size_t i) {
+    if (frame.header.bits == 8) {
+        return frame.payload[i];
+    }
+    uint16_t code;
+    std::memcpy(&code, frame.payload.data() + 2 * i, sizeof(code));
+    return code;
+}
+
+static inline void SetBarCode(PackedBarFrame& frame, size_t i, int code) {
+    if (frame.header.bits == 8) {
+        frame.payload[i] = static_cast<uint8_t>(code);
+    }
+    else {
+        uint16_t code16 = static_cast<uint16_t>(code);
+        std::memcpy(frame.payload.data() + 2 * i, &code16, sizeof(code16));
+    }
+}
+
+// Indica si se puede codificar 'frame' como diferencias respecto a 'previous'. Las diferencias
+// solo tienen sentido entre códigos con la misma escala.
+static bool IsDeltaCompatible(const BarFrameHeader& header, const PackedBarFrame* previous) {
+    return previous != nullptr
+        && previous->header.num_bars == header.num_bars
+        && previous->header.bits == header.bits
+        && previous->header.scale == header.scale
+        && previous->header.offset == header.offset
+        && previous->payload.size() == static_cast<size_t>(header.num_bars) * (header.bits / 8);
+}
+
+// Codificación de las diferencias en medios bytes (nibbles):
+//   0-13: diferencia en zigzag (0, -1, 1, -2, ... hasta -7)
+//   14:   serie de barras sin cambios; el siguiente nibble n indica n + BAR_DELTA_MIN_RUN barras
+//   15:   escape; le sigue el código completo de la barra (2 nibbles a 8 bits, 4 a 16 bits)
+// Las barras que no cambian son las más frecuentes (silencio, notas sostenidas), por eso tienen su propio símbolo.
+const unsigned int BAR_DELTA_MAX_ZIGZAG = 13;
+const unsigned int BAR_DELTA_RUN = 14;
+const unsigned int BAR_DELTA_ESCAPE = 15;
+const unsigned int BAR_DELTA_MIN_RUN = 3;
+const unsigned int BAR_DELTA_MAX_RUN = BAR_DELTA_MIN_RUN + 15;
+
+// Escribe nibbles en un vector de bytes, empezando por el nibble alto de cada byte.
+struct NibbleWriter {
+    std::vector<uint8_t>& out;
+    bool high = true;
+
+    void Put(unsigned int nibble) {
+        if (high) {
+            out.push_back(static_cast<uint8_t>(nibble << 4));
+        }
+        else {
+            out.back() |= static_cast<uint8_t>(nibble & 0x0F);
+        }
+        high = !high;
+    }
+};
+
+// Lee nibbles en el mismo orden en que los escribe NibbleWriter.
+struct NibbleReader {
+    const uint8_t* cursor;
+    const uint8_t* end;
+    bool high = true;
+
+    bool Get(unsigned int& nibble) {
+        if (cursor == end) {
+            return false;
+        }
+        if (high) {
+            nibble = *cursor >> 4;
+        }
+        else {
+            nibble = *cursor++ & 0x0F;
+        }
+        high = !high;
+        return true;
+    }
+};
+
+void SerializeBarFrame(const PackedBarFrame& frame, const PackedBarFrame* previous, std::vector<uint8_t>& out) {
+    BarFrameHeader header = frame.header;
+    bool use_delta = IsDeltaCompatible(header, previous);
+    header.flags = use_delta ? BAR_FRAME_FLAG_DELTA : 0;
+
+    out.resize(sizeof(BarFrameHeader));
+    std::memcpy(out.data(), &header, sizeof(BarFrameHeader));
+
+    if (!use_delta) {
+        out.insert(out.end(), frame.payload.begin(), frame.payload.end());
+        return;
+    }
+
+    NibbleWriter writer = { out };
+    const int code_nibbles = header.bits / 4;
+    unsigned int zero_run = 0;
+
+    // Vacía la serie de barras sin cambios pendiente: las series cortas salen más baratas como ceros sueltos.
+    auto flush_zero_run = [&]() {
+        while (zero_run >= BAR_DELTA_MIN_RUN) {
+            unsigned int run = std::min(zero_run, BAR_DELTA_MAX_RUN);
+            writer.Put(BAR_DELTA_RUN);
+            writer.Put(run - BAR_DELTA_MIN_RUN);
+            zero_run -= run;
+        }
+        for (; zero_run > 0; --zero_run) {
+            writer.Put(0);
+        }
+    };
+
+    for (size_t i = 0; i < header.num_bars; ++i) {
+        int code = GetBarCode(frame, i);
+        int32_t delta = code - GetBarCode(*previous, i);
+        if (delta == 0) {
+            ++zero_run;
+            continue;
+        }
+        flush_zero_run();
+
+        uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        if (zigzag <= BAR_DELTA_MAX_ZIGZAG) {
+            writer.Put(zigzag);
+        }
+        else {
+            writer.Put(BAR_DELTA_ESCAPE);
+            for (int shift = (code_nibbles - 1) * 4; shift >= 0; shift -= 4) {
+                writer.Put((code >> shift) & 0x0F);
+            }
+        }
+    }
+    flush_zero_run();
+
+    // Si las barras cambiaron demasiado, las diferencias ocupan más que los códigos: guardar sin codificar.
+    if (out.size() >= sizeof(BarFrameHeader) + frame.payload.size()) {
+        header.flags = 0;
+        out.resize(sizeof(BarFrameHeader));
+        std::memcpy(out.data(), &header, sizeof(BarFrameHeader));
+        out.insert(out.end(), frame.payload.begin(), frame.payload.end());
+    }
+}
+
+bool DeserializeBarFrame(const uint8_t* data, size_t size, const PackedBarFrame* previous, PackedBarFrame& frame) {
+    if (size < sizeof(BarFrameHeader)) {
+        return false;
+    }
+
+    BarFrameHeader header;
+    std::memcpy(&header, data, sizeof(BarFrameHeader));
+    if (header.bits != 8 && header.bits != 16) {
+        return false;
+    }
+
+    const size_t payload_size = static_cast<size_t>(header.num_bars) * (header.bits / 8);
+    const uint8_t* cursor = data + sizeof(BarFrameHeader);
+    const uint8_t* end = data + size;
+
+    if (!(header.flags & BAR_FRAME_FLAG_DELTA)) {
+        if (static_cast<size_t>(end - cursor) != payload_size) {
+            return false;
+        }
+        frame.header = header;
+        frame.payload.assign(cursor, end);
+        return true;
+    }
+
+    if (!IsDeltaCompatible(header, previous)) {
+        return false;
+    }
+
+    // Se decodifica en un fotograma temporal para admitir que 'previous' y 'frame' sean el mismo objeto.
+    PackedBarFrame decoded;
+    decoded.header = header;
+    decoded.header.flags = 0;
+    decoded.payload.resize(payload_size);
+    const int max_code = (header.bits == 8) ? 255 : 65535;
+    const int code_nibbles = header.bits / 4;
+
+    NibbleReader reader = { cursor, end };
+    size_t i = 0;
+    while (i < header.num_bars) {
+        unsigned int nibble;
+        if (!reader.Get(nibble)) {
+            return false;
+        }
+
+        if (nibble == BAR_DELTA_RUN) {
+            unsigned int run;
+            if (!reader.Get(run)) {
+                return false;
+            }
+            run += BAR_DELTA_MIN_RUN;
+            if (run > header.num_bars - i) {
+                return false;
+            }
+            for (; run > 0; --run, ++i) {
+                SetBarCode(decoded, i, GetBarCode(*previous, i));
+            }
+            continue;
+        }
+
+        int code;
+        if (nibble == BAR_DELTA_ESCAPE) {
+            code = 0;
+            for (int k = 0; k < code_nibbles; ++k) {
+                unsigned int part;
+                if (!reader.Get(part)) {
+                    return false;
+                }
+                code = (code << 4) | static_cast<int>(part);
+            }
+        }
+        else {
+            int32_t delta = static_cast<int32_t>(nibble >> 1) ^ -static_cast<int32_t>(nibble & 1);
+            code = GetBarCode(*previous, i) + delta;
+        }
+        if (code < 0 || code > max_code) {
+            return false;
+        }
+        SetBarCode(decoded, i, code);
+        ++i;
+    }
+
+    // Solo puede sobrar el relleno del último byte.
+    if (!reader.high) {
+        ++reader.cursor;
+    }
+    if (reader.cursor != end) {
+        return false;
+    }
+    frame = std::move(decoded);
+    return true;
+}
+
+void WriteBarFrameFileHeader(std::ostream& stream) {
+    stream.write(BAR_FRAME_FILE_MAGIC, sizeof(BAR_FRAME_FILE_MAGIC));
+    stream.write(reinterpret_cast<const char*>(&BAR_FRAME_FILE_VERSION), sizeof(BAR_FRAME_FILE_VERSION));
+}
+
+bool ReadBarFrameFileHeader(std::istream& stream) {
+    char magic[sizeof(BAR_FRAME_FILE_MAGIC)];
+    uint32_t version = 0;
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+    return stream
+        && std::memcmp(magic, BAR_FRAME_FILE_MAGIC, sizeof(magic)) == 0
+        && version == BAR_FRAME_FILE_VERSION;
+}
+
+void WriteBarFrameRecord(std::ostream& stream, const PackedBarFrame& frame, const PackedBarFrame* previous, std::vector<uint8_t>& scratch) {
+    SerializeBarFrame(frame, previous, scratch);
+    uint32_t record_size = static_cast<uint32_t>(scratch.size());
+    stream.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+    stream.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+}
+
+bool ReadBarFrameRecord(std::istream& stream, const PackedBarFrame* previous, PackedBarFrame& frame, std::vector<uint8_t>& scratch) {
+    uint32_t record_size = 0;
+    if (!stream.read(reinterpret_cast<char*>(&record_size), sizeof(record_size))) {
+        return false;
+    }
+    // Un fotograma nunca ocupa más que su cabecera y 65535 barras de 16 bits; un tamaño mayor indica un archivo dañado.
+    if (record_size > sizeof(BarFrameHeader) + 65535 * 2) {
+        return false;
+    }
+    scratch.resize(record_size);
+    if (!stream.read(reinterpret_cast<char*>(scratch.data()), record_size)) {
+        return false;
+    }
+    return DeserializeBarFrame(scratch.data(), scratch.size(), previous, frame);
+}
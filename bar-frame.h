@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+// Bandera de cabecera: la carga útil está codificada como diferencias respecto al fotograma anterior.
+const uint8_t BAR_FRAME_FLAG_DELTA = 0x01;
+
+// Identificador y versión del formato de los archivos de grabación.
+const char BAR_FRAME_FILE_MAGIC[4] = { 'A', 'V', 'B', 'F' };
+const uint32_t BAR_FRAME_FILE_VERSION = 1;
+
+// Cabecera de un fotograma de barras cuantizado. Cada barra se reconstruye como
+// offset + código * scale, donde el código ocupa 8 o 16 bits.
+struct BarFrameHeader {
+    uint32_t num_bars;
+    // Bits por código: 8 o 16.
+    uint8_t bits;
+    uint8_t flags;
+    // Columnas de la ventana que cubre cada barra (más de una cuando el planificador reduce las barras).
+    uint16_t columns_per_bar;
+    float scale;
+    float offset;
+};
+
+static_assert(sizeof(BarFrameHeader) == 16, "BarFrameHeader debe ocupar 16 bytes");
+
+// Fotograma de barras empaquetado: cabecera más los códigos cuantizados.
+// Sustituye al vector de doubles (8 bytes por barra) en la entrega al renderizador.
+struct PackedBarFrame {
+    BarFrameHeader header = { 0, 16, 0, 1, 0.0f, 0.0f };
+    // Códigos de las barras, uint8_t o uint16_t según header.bits.
+    std::vector<uint8_t> payload;
+};
+
+// Cuantiza 'num_bars' valores en el fotograma usando el rango del propio fotograma.
+// Usa SSE2 cuando está disponible.
+void PackBarFrame(const double* values, int num_bars, int bits, PackedBarFrame& frame);
+
+// Igual que PackBarFrame, pero con un rango fijo [min_value, max_value]. Con un rango fijo
+// la escala no cambia entre fotogramas, que es lo que necesita la codificación por diferencias.
+void PackBarFrameRange(const double* values, int num_bars, int bits, double min_value, double max_value, PackedBarFrame& frame);
+
+// Valor reconstruido de la barra 'i' de un fotograma empaquetado.
+inline double GetBarValue(const PackedBarFrame& frame, int i) {
+    unsigned int code;
+    if (frame.header.bits == 8) {
+        code = frame.payload[i];
+    }
+    else {
+        // memcpy en lugar de reinterpret_cast: la carga útil es un vector de bytes.
+        uint16_t code16;
+        std::memcpy(&code16, frame.payload.data() + 2 * static_cast<size_t>(i), sizeof(code16));
+        code = code16;
+    }
+    return frame.header.offset + code * frame.header.scale;
+}
+
+// Serializa un fotograma (cabecera y carga útil). Si 'previous' es compatible (mismo número
+// de barras, bits, escala y desplazamiento), los códigos se guardan como diferencias en medios bytes:
+// una diferencia pequeña ocupa 4 bits y una serie de barras sin cambios ocupa 8 bits en total.
+// Si la codificación no ahorra espacio, se guardan los códigos sin codificar.
+void SerializeBarFrame(const PackedBarFrame& frame, const PackedBarFrame* previous, std::vector<uint8_t>& out);
+
+// Reconstruye un fotograma serializado. Devuelve false si los datos no son válidos
+// o si están codificados como diferencias y 'previous' no es compatible.
+bool DeserializeBarFrame(const uint8_t* data, size_t size, const PackedBarFrame* previous, PackedBarFrame& frame);
+
+// Escribe la cabecera de un archivo de grabación (identificador y versión).
+void WriteBarFrameFileHeader(std::ostream& stream);
+
+// Lee y comprueba la cabecera de un archivo de grabación.
+bool ReadBarFrameFileHeader(std::istream& stream);
+
+// Escribe un fotograma serializado en un archivo de grabación, precedido de su tamaño en bytes (uint32_t).
+void WriteBarFrameRecord(std::ostream& stream, const PackedBarFrame& frame, const PackedBarFrame* previous, std::vector<uint8_t>& scratch);
+
+// Lee el siguiente fotograma de un archivo de grabación. 'previous' es el último fotograma leído
+// (o nullptr en el primero) y puede ser el mismo objeto que 'frame'. Devuelve false al final del
+// archivo o si el registro no es válido.
+bool ReadBarFrameRecord(std::istream& stream, const PackedBarFrame* previous, PackedBarFrame& frame, std::vector<uint8_t>& scratch);
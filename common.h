@@ -4,28 +4,78 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include "config.h"
+#include "deadline-scheduler.h"
+#include "bar-frame.h"
 
 // Tamaño de la ventana de la FFT.
 const int FFT_SIZE = 4096;
 
+// Frecuencia de muestreo (Sample rate) del audio.
+// Este valor es crucial para el cálculo de la resolución de la FFT.
+const double SAMPLE_RATE = 44100.0;
+
+// Valor máximo (dB) de una barra. Los valores se limitan al rango [0, MAX_BAR_VALUE].
+const double MAX_BAR_VALUE = 50.0;
+
+// El planificador de FFTW no es seguro entre hilos: toda creación y destrucción
+// de planes debe hacerse con este mutex bloqueado.
+extern std::mutex fftw_planner_mtx;
+
 // Estructura de datos compartida entre el hilo de captura y el de procesamiento
 struct AudioData {
     std::mutex mtx;
     std::condition_variable cv;
     std::vector<double> in_data; // Vector para almacenar la entrada de audio
+    // Número de secuencia del bloque en in_data. Lo incrementa el hilo de captura con cada bloque,
+    // así el hilo de procesamiento detecta bloques nuevos, repetidos o perdidos.
+    uint64_t sequence = 0;
+    // Momento en que el hilo de captura publicó el bloque, para medir el retraso hasta su fotograma.
+    std::chrono::steady_clock::time_point publish_time;
 };
 
 // Estructura de datos compartida entre el hilo de procesamiento y el de renderizado
 struct VisualizerData {
     std::mutex mtx;
     std::condition_variable cv;
-    // Dos búferes para la técnica de doble amortiguación
-    std::vector<double> out_data[2];
+    // Dos fotogramas empaquetados para la técnica de doble amortiguación
+    PackedBarFrame out_frames[2];
     // Índice atómico para indicar qué búfer es el que se está escribiendo actualmente
     std::atomic<int> write_buffer_index;
     // Variable atómica para comunicar el número de barras entre hilos
     std::atomic<int> atomic_num_bars;
     // Bandera para indicar a los hilos que deben terminar
     std::atomic<bool> should_terminate;
+    // Planificador que reduce la calidad cuando los hilos no cumplen sus plazos
+    DeadlineScheduler scheduler;
+    // Bytes escritos en el archivo de grabación y los que ocuparían los mismos fotogramas
+    // sin diferencias, para mostrar el ahorro de la codificación en el título de la ventana.
+    std::atomic<unsigned long long> recorded_bytes{ 0 };
+    std::atomic<unsigned long long> recorded_raw_bytes{ 0 };
+};
+
+// Estructura de datos compartida para el modo zoom de alta resolución.
+// El hilo de captura alimenta el historial con AppendZoomSamples y el hilo de zoom publica las barras
+// de la banda seleccionada. El historial y los búferes de salida se leen y escriben con 'mtx' bloqueado.
+struct ZoomData {
+    std::mutex mtx;
+    std::condition_variable cv;
+    // Historial circular con las últimas muestras de audio (tamaño de la FFT de zoom)
+    std::vector<double> history;
+    // Posición de escritura en el historial, que también marca la muestra más antigua
+    size_t history_pos;
+    // Indica que han llegado muestras nuevas desde la última transformación
+    bool has_new_samples;
+    // Dos búferes para la técnica de doble amortiguación (protegidos por 'mtx', ya que cambian de tamaño)
+    std::vector<double> out_data[2];
+    // Índice atómico para indicar qué búfer es el que se está escribiendo actualmente
+    std::atomic<int> write_buffer_index;
+    // Bandera que indica que el hilo de zoom está preparado y recibiendo muestras
+    std::atomic<bool> active;
+    // Resultado de la medición inicial: tiempo medio (ms) de la FFT de zoom con un hilo y con varios.
+    // Valen 0 mientras no se haya medido.
+    std::atomic<double> benchmark_single_ms;
+    std::atomic<double> benchmark_threaded_ms;
 };
@@ -48,6 +48,43 @@ void LoadConfig(SharedConfigData& sharedConfigData, const std::string& filename)
                 sharedConfigData.config.bin_grouping_factor = 10.0f; // Valor por defecto
             }
         }
+
+        // Leer la configuración opcional del modo zoom.
+        if (data.contains("zoom")) {
+            const auto& zoom = data["zoom"];
+            if (zoom.contains("enabled")) {
+                sharedConfigData.config.zoom_enabled = zoom["enabled"].get<bool>();
+            }
+            if (zoom.contains("fft_size")) {
+                sharedConfigData.config.zoom_fft_size = zoom["fft_size"].get<int>();
+            }
+            if (zoom.contains("min_frequency")) {
+                sharedConfigData.config.zoom_min_frequency = zoom["min_frequency"].get<float>();
+            }
+            if (zoom.contains("max_frequency")) {
+                sharedConfigData.config.zoom_max_frequency = zoom["max_frequency"].get<float>();
+            }
+            if (zoom.contains("threads")) {
+                sharedConfigData.config.zoom_threads = zoom["threads"].get<int>();
+            }
+            if (zoom.contains("benchmark")) {
+                sharedConfigData.config.zoom_benchmark = zoom["benchmark"].get<bool>();
+            }
+        }
+
+        // Leer la configuración opcional del formato de los fotogramas de barras.
+        if (data.contains("formato_barras")) {
+            const auto& formato = data["formato_barras"];
+            if (formato.contains("bits")) {
+                sharedConfigData.config.bar_frame_bits = formato["bits"].get<int>() == 8 ? 8 : 16;
+            }
+            if (formato.contains("record_file")) {
+                sharedConfigData.config.record_file = formato["record_file"].get<std::string>();
+            }
+            if (formato.contains("delta_encoding")) {
+                sharedConfigData.config.record_delta_encoding = formato["delta_encoding"].get<bool>();
+            }
+        }
     }
     catch (const json::parse_error& e) {
         std::cerr << "Error de parseo del JSON en el archivo " << filename << ": " << e.what() << std::endl;
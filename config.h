@@ -20,6 +20,25 @@ struct VisualizerConfig {
     std::vector<float> base_color_rgb;
     // Factor de agrupamiento de bins para controlar el ancho de banda por barra.
     float bin_grouping_factor;
+    // Modo zoom: FFT de gran tamaño sobre una banda de frecuencias seleccionada.
+    // Tienen valores por defecto porque la sección "zoom" del archivo es opcional.
+    bool zoom_enabled = false;
+    // Tamaño de la FFT de zoom (entre 65536 y 262144 puntos).
+    int zoom_fft_size = 65536;
+    // Banda de frecuencias (Hz) que se reparte entre las barras en el modo zoom.
+    float zoom_min_frequency = 20.0f;
+    float zoom_max_frequency = 2000.0f;
+    // Número de hilos que usa FFTW para la FFT de zoom.
+    int zoom_threads = 4;
+    // Medir al inicio la aceleración frente a la FFT de un solo hilo.
+    bool zoom_benchmark = true;
+    // Bits por barra (8 o 16) de los fotogramas empaquetados que se entregan al renderizador.
+    int bar_frame_bits = 16;
+    // Archivo donde grabar los fotogramas empaquetados. Vacío para no grabar.
+    std::string record_file;
+    // Grabar cada fotograma como diferencias respecto al anterior. Los fotogramas grabados se
+    // cuantifican aparte, a 8 bits con un paso fijo de 0.5 dB, sea cual sea 'bar_frame_bits'.
+    bool record_delta_encoding = true;
 };
 
 // Estructura de datos compartida para pasar la configuración entre hilos.
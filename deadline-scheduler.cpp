@@ -0,0 +1,114 @@
+#include "deadline-scheduler.h"
+#include <iostream>
+#include <algorithm>
+
+// Peso de cada nueva muestra en la media móvil exponencial de la carga.
+const double LOAD_SMOOTHING = 0.2;
+// Por encima de este porcentaje del tiempo disponible se considera que hay presión.
+const double HIGH_LOAD_THRESHOLD = 0.85;
+// Por debajo de este porcentaje se considera que hay margen para recuperar calidad.
+// Debe ser menor que la mitad del umbral alto: al volver a un salto normal el tiempo
+// disponible por bloque se reduce a la mitad y la carga se duplica.
+const double LOW_LOAD_THRESHOLD = 0.4;
+// Muestras consecutivas necesarias para bajar o subir de nivel (histéresis).
+const int DEGRADE_SAMPLES = 3;
+const int RESTORE_SAMPLES = 120;
+// Carga que se registra por cada bloque perdido: un plazo incumplido equivale a una sobrecarga clara.
+const double MISSED_BLOCK_LOAD = 2.0;
+
+// Nombres de los niveles para los mensajes de registro.
+static const char* QUALITY_LEVEL_NAMES[QUALITY_LEVEL_COUNT] = {
+    "completa",
+    "salto mayor",
+    "menos barras",
+    "magnitud y escala aproximadas",
+    "renderizado reducido"
+};
+
+// Decide si hay que cambiar de nivel a partir de la carga actual. Se llama con el mutex bloqueado.
+static void UpdateQualityLevel(DeadlineScheduler& scheduler) {
+    double load = std::max(scheduler.processing_load, scheduler.render_load);
+    int level = scheduler.quality_level.load();
+
+    if (load > HIGH_LOAD_THRESHOLD) {
+        scheduler.under_budget_samples = 0;
+        if (++scheduler.over_budget_samples >= DEGRADE_SAMPLES && level < QUALITY_LEVEL_COUNT - 1) {
+            scheduler.quality_level.store(level + 1);
+            scheduler.degrade_transitions.fetch_add(1);
+            scheduler.over_budget_samples = 0;
+            std::cout << "Planificador: calidad reducida a '" << QUALITY_LEVEL_NAMES[level + 1]
+                << "' (carga " << load << ")." << std::endl;
+        }
+    }
+    else if (load < LOW_LOAD_THRESHOLD) {
+        scheduler.over_budget_samples = 0;
+        if (++scheduler.under_budget_samples >= RESTORE_SAMPLES && level > QUALITY_FULL) {
+            scheduler.quality_level.store(level - 1);
+            scheduler.restore_transitions.fetch_add(1);
+            scheduler.under_budget_samples = 0;
+            std::cout << "Planificador: calidad restaurada a '" << QUALITY_LEVEL_NAMES[level - 1]
+                << "' (carga " << load << ")." << std::endl;
+        }
+    }
+    else {
+        scheduler.over_budget_samples = 0;
+        scheduler.under_budget_samples = 0;
+    }
+}
+
+void ReportProcessingTime(DeadlineScheduler& scheduler, double elapsed_seconds, double budget_seconds) {
+    if (budget_seconds <= 0.0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(scheduler.mtx);
+    double load = elapsed_seconds / budget_seconds;
+    scheduler.processing_load += LOAD_SMOOTHING * (load - scheduler.processing_load);
+    UpdateQualityLevel(scheduler);
+}
+
+void ReportMissedBlocks(DeadlineScheduler& scheduler, unsigned long long count) {
+    if (count == 0) {
+        return;
+    }
+    scheduler.missed_blocks.fetch_add(count);
+    std::unique_lock<std::mutex> lock(scheduler.mtx);
+    // Cada bloque perdido cuenta como una muestra de sobrecarga; basta con DEGRADE_SAMPLES para reaccionar.
+    unsigned long long samples = std::min<unsigned long long>(count, DEGRADE_SAMPLES);
+    for (unsigned long long i = 0; i < samples; ++i) {
+        scheduler.processing_load += LOAD_SMOOTHING * (MISSED_BLOCK_LOAD - scheduler.processing_load);
+        UpdateQualityLevel(scheduler);
+    }
+}
+
+void ReportRenderTime(DeadlineScheduler& scheduler, double elapsed_seconds, double budget_seconds) {
+    if (budget_seconds <= 0.0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(scheduler.mtx);
+    double load = elapsed_seconds / budget_seconds;
+    scheduler.render_load += LOAD_SMOOTHING * (load - scheduler.render_load);
+    UpdateQualityLevel(scheduler);
+}
+
+int GetHopMultiplier(int quality_level) {
+    return quality_level >= QUALITY_LARGER_HOP ? 2 : 1;
+}
+
+int GetBarStep(int quality_level) {
+    return quality_level >= QUALITY_FEWER_BARS ? 4 : 1;
+}
+
+bool UseCheapDsp(int quality_level) {
+    return quality_level >= QUALITY_CHEAP_DSP;
+}
+
+int GetSwapInterval(int quality_level) {
+    return quality_level >= QUALITY_LOW_RENDER_RATE ? 2 : 1;
+}
+
+const char* GetQualityLevelName(int quality_level) {
+    if (quality_level < 0 || quality_level >= QUALITY_LEVEL_COUNT) {
+        return "desconocida";
+    }
+    return QUALITY_LEVEL_NAMES[quality_level];
+}
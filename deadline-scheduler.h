@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+// Niveles de calidad del visualizador, ordenados de mayor a menor coste.
+// Cada nivel incluye también las reducciones de todos los niveles anteriores.
+enum QualityLevel {
+    // Calidad completa: se procesa cada bloque, una barra por columna, magnitud
+    // y escala logarítmica exactas y renderizado a la frecuencia del monitor.
+    QUALITY_FULL = 0,
+    // Salto (hop) mayor: solo se procesa uno de cada dos bloques de audio.
+    QUALITY_LARGER_HOP = 1,
+    // Menos barras: cada barra calculada cubre varias columnas de la ventana.
+    QUALITY_FEWER_BARS = 2,
+    // Magnitud aproximada sin raíz cuadrada y escala en dB aproximada sin log10.
+    // La ventana ya es rectangular en todos los niveles, así que no hay una más barata.
+    QUALITY_CHEAP_DSP = 3,
+    // Frecuencia de renderizado reducida a la mitad del refresco del monitor.
+    QUALITY_LOW_RENDER_RATE = 4
+};
+
+const int QUALITY_LEVEL_COUNT = 5;
+
+// Planificador por plazos compartido entre el hilo de procesamiento y el de renderizado.
+// Compara el tiempo de procesamiento de cada bloque con el periodo del bloque de audio
+// y el tiempo de cada fotograma con el periodo del monitor, y ajusta la calidad.
+struct DeadlineScheduler {
+    // Nivel de calidad actual (QualityLevel). Los hilos lo leen sin bloquear.
+    std::atomic<int> quality_level{ QUALITY_FULL };
+    // Contadores de transiciones para poder supervisar el comportamiento del planificador.
+    std::atomic<unsigned long long> degrade_transitions{ 0 };
+    std::atomic<unsigned long long> restore_transitions{ 0 };
+    // Bloques de audio sobrescritos por el hilo de captura antes de que se procesaran (plazos incumplidos).
+    std::atomic<unsigned long long> missed_blocks{ 0 };
+
+    // Estado interno, protegido por el mutex.
+    std::mutex mtx;
+    // Carga suavizada (tiempo usado / tiempo disponible) de cada hilo.
+    double processing_load = 0.0;
+    double render_load = 0.0;
+    // Muestras consecutivas por encima o por debajo de los umbrales.
+    int over_budget_samples = 0;
+    int under_budget_samples = 0;
+};
+
+// Registra el retraso de un bloque (desde que se capturó hasta que se publicó su fotograma)
+// frente al tiempo disponible.
+void ReportProcessingTime(DeadlineScheduler& scheduler, double elapsed_seconds, double budget_seconds);
+// Registra bloques que se perdieron porque el hilo de procesamiento no llegó a leerlos.
+void ReportMissedBlocks(DeadlineScheduler& scheduler, unsigned long long count);
+// Registra el tiempo que tardó en prepararse un fotograma frente al tiempo disponible.
+void ReportRenderTime(DeadlineScheduler& scheduler, double elapsed_seconds, double budget_seconds);
+
+// Parámetros derivados de un nivel de calidad.
+int GetHopMultiplier(int quality_level);
+int GetBarStep(int quality_level);
+bool UseCheapDsp(int quality_level);
+int GetSwapInterval(int quality_level);
+
+// Nombre legible de un nivel de calidad, para mostrarlo al usuario.
+const char* GetQualityLevelName(int quality_level);
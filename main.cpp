@@ -5,6 +5,7 @@
 #include "audio-capture.h"
 #include "audio-processing.h"
 #include "renderer.h"
+#include "zoom-processing.h"
 #include "config.h"
 
 int main() {
@@ -21,8 +22,6 @@ int main() {
     VisualizerData sharedVisualizerData;
     // Inicializamos con un valor por defecto.
     const int DEFAULT_WINDOW_WIDTH = 1024;
-    sharedVisualizerData.out_data[0].resize(DEFAULT_WINDOW_WIDTH);
-    sharedVisualizerData.out_data[1].resize(DEFAULT_WINDOW_WIDTH);
     sharedVisualizerData.write_buffer_index.store(0);
     sharedVisualizerData.atomic_num_bars.store(DEFAULT_WINDOW_WIDTH);
     sharedVisualizerData.should_terminate.store(false);
@@ -32,26 +31,53 @@ int main() {
     // Cargar la configuración desde el archivo.
     LoadConfig(sharedConfigData, "config.json");
 
+    // Crear una instancia de la estructura de datos compartida para el modo zoom.
+    ZoomData sharedZoomData;
+    sharedZoomData.history_pos = 0;
+    sharedZoomData.has_new_samples = false;
+    sharedZoomData.write_buffer_index.store(0);
+    sharedZoomData.active.store(false);
+    sharedZoomData.benchmark_single_ms.store(0.0);
+    sharedZoomData.benchmark_threaded_ms.store(0.0);
+
+    // Inicializar el soporte multihilo de FFTW antes de que se cree cualquier plan.
+    if (!InitializeFFTWThreads()) {
+        sharedConfigData.config.zoom_enabled = false;
+    }
+
     // Crear un hilo para la captura de audio.
-    std::thread audioCaptureThread(AudioCaptureThread, std::ref(sharedAudioData), std::ref(sharedVisualizerData));
+    std::thread audioCaptureThread(AudioCaptureThread, std::ref(sharedAudioData), std::ref(sharedVisualizerData), std::ref(sharedZoomData));
 
     // Crear un hilo para el procesamiento de la señal.
     std::thread signalProcessingThread(AudioProcessingThread, std::ref(sharedAudioData), std::ref(sharedVisualizerData), std::ref(sharedConfigData));
 
+    // Crear un hilo para el modo zoom. Termina enseguida si el modo está desactivado en la configuración.
+    std::thread zoomProcessingThread(ZoomProcessingThread, std::ref(sharedZoomData), std::ref(sharedVisualizerData), std::ref(sharedConfigData));
+
     // Crear un hilo para el renderizado de la visualización, pasándole los datos de visualización y de configuración.
-    std::thread renderThread(RenderThread, std::ref(sharedVisualizerData), std::ref(sharedConfigData));
+    std::thread renderThread(RenderThread, std::ref(sharedVisualizerData), std::ref(sharedZoomData), std::ref(sharedConfigData));
 
     // Esperar a que el hilo de renderizado termine (cuando la ventana se cierra).
     renderThread.join();
 
     // Notificar a los otros hilos que deben terminar.
     sharedVisualizerData.should_terminate.store(true);
+    {
+        // Bloquear el mutex para que el aviso no se pierda entre la comprobación y la espera del hilo de procesamiento.
+        std::unique_lock<std::mutex> lock(sharedAudioData.mtx);
+    }
     sharedAudioData.cv.notify_one();
     sharedVisualizerData.cv.notify_one();
+    {
+        // Bloquear el mutex para que el aviso no se pierda entre la comprobación y la espera del hilo de zoom.
+        std::unique_lock<std::mutex> lock(sharedZoomData.mtx);
+    }
+    sharedZoomData.cv.notify_one();
 
     // Esperar a que los hilos restantes terminen.
     audioCaptureThread.join();
     signalProcessingThread.join();
+    zoomProcessingThread.join();
 
     return 0;
 }
@@ -4,11 +4,15 @@
 #include <GL/gl.h>
 #include <cmath>
 #include <atomic>
+#include <algorithm>
+#include <string>
 #include "config.h"
 
 // Factor para el espacio entre las barras, como un porcentaje del ancho de la barra.
 // Un valor de 0.1 significa un espacio del 10% del ancho de la barra.
 const float BAR_GAP_FACTOR = 0.1f;
+// Borde inferior del panel de zoom, en coordenadas normalizadas. Las barras normales llegan hasta 0.5.
+const float ZOOM_PANEL_BOTTOM = 0.55f;
 
 // Almacenamos las alturas actuales de las barras para implementar el decaimiento.
 static std::vector<double> current_heights;
@@ -26,12 +30,8 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
         int new_num_bars = width;
         sharedVisualizerDataPtr->atomic_num_bars.store(new_num_bars);
 
-        // Bloquear el mutex del búfer de visualización para redimensionar de forma segura.
-        std::unique_lock<std::mutex> lock(sharedVisualizerDataPtr->mtx);
-
-        // Redimensionar los búferes de datos compartidos para que coincidan con el nuevo ancho.
-        sharedVisualizerDataPtr->out_data[0].resize(new_num_bars, 0.0);
-        sharedVisualizerDataPtr->out_data[1].resize(new_num_bars, 0.0);
+        // Los fotogramas empaquetados guardan su propio número de barras, así que no hace falta
+        // redimensionarlos aquí: el renderizador dibuja a cero las barras que aún no tienen datos.
 
         // Redimensionar los búferes de decaimiento y suavizado.
         current_heights.resize(new_num_bars, 0.0);
@@ -43,8 +43,20 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     }
 }
 
+// Reagrupa las alturas cuando cambia el número de columnas por barra, para que cada nueva barra
+// conserve la altura de la barra que antes cubría su primera columna y no salte a cero.
+static void RegroupHeights(std::vector<double>& heights, int old_columns_per_bar, int new_columns_per_bar) {
+    std::vector<double> regrouped(heights.size(), 0.0);
+    size_t num_groups = (heights.size() + new_columns_per_bar - 1) / new_columns_per_bar;
+    for (size_t g = 0; g < num_groups; ++g) {
+        size_t old_group = std::min(g * new_columns_per_bar / old_columns_per_bar, heights.size() - 1);
+        regrouped[g] = heights[old_group];
+    }
+    heights.swap(regrouped);
+}
+
 // The main rendering thread function
-void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& sharedConfigData) {
+void RenderThread(VisualizerData& sharedVisualizerData, ZoomData& zoomData, SharedConfigData& sharedConfigData) {
     std::cout << "Rendering thread started." << std::endl;
     // Asignar el puntero para que la función de callback pueda acceder a los datos.
     sharedVisualizerDataPtr = &sharedVisualizerData;
@@ -78,7 +90,28 @@ void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& shared
 
     // Make the window's context current.
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1); // Enable V-Sync to synchronize with the monitor's refresh rate.
+    int swap_interval = 1;
+    glfwSwapInterval(swap_interval); // Enable V-Sync to synchronize with the monitor's refresh rate.
+
+    // Periodo del monitor: el tiempo disponible para preparar cada fotograma.
+    const GLFWvidmode* video_mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    const double refresh_rate = (video_mode && video_mode->refreshRate > 0) ? video_mode->refreshRate : 60.0;
+    const double display_period = 1.0 / refresh_rate;
+
+    // Último estado del planificador mostrado en el título. La consola se oculta al iniciar,
+    // así que el título de la ventana es donde se ven el nivel y los contadores de transiciones.
+    int shown_quality_level = -1;
+    unsigned long long shown_transitions = 0;
+    unsigned long long shown_missed_blocks = 0;
+    int shown_record_percent = -1;
+    bool shown_zoom_benchmark = false;
+
+    // Copia local del último fotograma publicado. Se reutiliza entre fotogramas para no reservar memoria.
+    PackedBarFrame frame;
+    // Columnas por barra con las que están agrupadas current_heights y smoothed_heights.
+    int drawn_columns_per_bar = 1;
+    // Copia local de las barras de zoom, reutilizada entre fotogramas.
+    std::vector<double> zoom_bars;
 
     // Registrar la función de callback de redimensionamiento.
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -88,6 +121,50 @@ void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& shared
         // Poll for and process events.
         glfwPollEvents();
 
+        double frame_start_time = glfwGetTime();
+
+        // Reducir la frecuencia de renderizado si el planificador lo pide.
+        int new_swap_interval = GetSwapInterval(sharedVisualizerData.scheduler.quality_level.load());
+        if (new_swap_interval != swap_interval) {
+            swap_interval = new_swap_interval;
+            glfwSwapInterval(swap_interval);
+        }
+
+        // Actualizar el título solo cuando cambia el nivel o algún contador.
+        int quality_level = sharedVisualizerData.scheduler.quality_level.load();
+        unsigned long long degrade_transitions = sharedVisualizerData.scheduler.degrade_transitions.load();
+        unsigned long long restore_transitions = sharedVisualizerData.scheduler.restore_transitions.load();
+        unsigned long long missed_blocks = sharedVisualizerData.scheduler.missed_blocks.load();
+        double zoom_single_ms = zoomData.benchmark_single_ms.load();
+        double zoom_threaded_ms = zoomData.benchmark_threaded_ms.load();
+        bool has_zoom_benchmark = zoom_threaded_ms > 0.0;
+        // Tamaño de la grabación respecto a los mismos fotogramas sin diferencias (-1 si no se graba).
+        unsigned long long recorded_raw_bytes = sharedVisualizerData.recorded_raw_bytes.load();
+        int record_percent = recorded_raw_bytes > 0
+            ? static_cast<int>(100 * sharedVisualizerData.recorded_bytes.load() / recorded_raw_bytes) : -1;
+        if (quality_level != shown_quality_level || degrade_transitions + restore_transitions != shown_transitions
+            || missed_blocks != shown_missed_blocks || has_zoom_benchmark != shown_zoom_benchmark
+            || record_percent != shown_record_percent) {
+            shown_record_percent = record_percent;
+            shown_quality_level = quality_level;
+            shown_transitions = degrade_transitions + restore_transitions;
+            shown_missed_blocks = missed_blocks;
+            shown_zoom_benchmark = has_zoom_benchmark;
+            std::string title = std::string("Audio Visualizer - calidad: ") + GetQualityLevelName(quality_level)
+                + " (reducciones: " + std::to_string(degrade_transitions)
+                + ", restauraciones: " + std::to_string(restore_transitions)
+                + ", bloques perdidos: " + std::to_string(missed_blocks) + ")";
+            // Resultado de la medición de la FFT de zoom multihilo frente a la de un hilo.
+            if (has_zoom_benchmark) {
+                title += " - zoom: " + std::to_string(zoom_single_ms) + " ms / " + std::to_string(zoom_threaded_ms)
+                    + " ms (x" + std::to_string(zoom_single_ms / zoom_threaded_ms) + ")";
+            }
+            if (record_percent >= 0) {
+                title += " - grabación: " + std::to_string(record_percent) + "% del tamaño sin diferencias";
+            }
+            glfwSetWindowTitle(window, title.c_str());
+        }
+
         // Clear the screen to a dark gray color.
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
@@ -95,14 +172,36 @@ void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& shared
         // Begin drawing quads (rectangles) for the bars.
         glBegin(GL_QUADS);
 
-        // Get the index of the buffer that the processing thread just wrote to
-        int read_index = sharedVisualizerData.write_buffer_index.load();
+        // Get the index of the buffer that the processing thread just wrote to.
+        // The processing thread has already flipped the index, so the last written buffer is the other one.
+        // Copy it under the mutex: the processing thread may resize it while packing the next frame.
+        std::unique_lock<std::mutex> frame_lock(sharedVisualizerData.mtx);
+        int read_index = 1 - sharedVisualizerData.write_buffer_index.load();
+        const PackedBarFrame& shared_frame = sharedVisualizerData.out_frames[read_index];
+        frame.header = shared_frame.header;
+        frame.payload.assign(shared_frame.payload.begin(), shared_frame.payload.end());
+        frame_lock.unlock();
+
         int current_num_bars = sharedVisualizerData.atomic_num_bars.load();
 
+        // Número de barras disponibles en el fotograma empaquetado (puede diferir tras redimensionar).
+        int frame_num_bars = static_cast<int>(std::min<size_t>(frame.header.num_bars, frame.payload.size() / (frame.header.bits / 8)));
+
+        // Con menos barras, cada barra del fotograma cubre varias columnas: se dibuja un solo quad por
+        // barra y el decaimiento y el suavizado se calculan por barra, no por columna.
+        int columns_per_bar = std::max<int>(frame.header.columns_per_bar, 1);
+        if (columns_per_bar != drawn_columns_per_bar) {
+            RegroupHeights(current_heights, drawn_columns_per_bar, columns_per_bar);
+            RegroupHeights(smoothed_heights, drawn_columns_per_bar, columns_per_bar);
+            drawn_columns_per_bar = columns_per_bar;
+        }
+        int num_groups = (current_num_bars + columns_per_bar - 1) / columns_per_bar;
+        double column_width = 2.0 / current_num_bars;
+
         // Loop through the data and draw a bar for each frequency bin.
-        for (int i = 0; i < current_num_bars; ++i) {
-            // Leer los datos procesados del búfer compartido.
-            double raw_value = sharedVisualizerData.out_data[read_index][i];
+        for (int i = 0; i < num_groups; ++i) {
+            // Leer los datos procesados directamente del fotograma empaquetado.
+            double raw_value = i < frame_num_bars ? GetBarValue(frame, i) : 0.0;
 
             // Implementar decaimiento: las barras caen gradualmente.
             if (raw_value > current_heights[i]) {
@@ -122,9 +221,10 @@ void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& shared
             if (bar_height_normalized > 1.0) bar_height_normalized = 1.0;
             if (bar_height_normalized < 0.0) bar_height_normalized = 0.0;
 
-            // Bar dimensions and position.
-            double bar_width = 2.0 / current_num_bars;
-            double x_position = -1.0 + i * bar_width;
+            // Bar dimensions and position. La última barra puede cubrir menos columnas.
+            int first_column = i * columns_per_bar;
+            double bar_width = std::min(columns_per_bar, current_num_bars - first_column) * column_width;
+            double x_position = -1.0 + first_column * column_width;
 
             // Ajustar el ancho de la barra para crear un espacio.
             double adjusted_bar_width = bar_width * (1.0 - BAR_GAP_FACTOR);
@@ -146,6 +246,33 @@ void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& shared
         // End drawing.
         glEnd();
 
+        // Dibujar el espectro de la banda de zoom como una línea sobre las barras.
+        if (zoomData.active.load()) {
+            // El hilo de zoom ya alternó el índice, así que el último búfer escrito es el otro.
+            // Se copia con el mutex bloqueado porque el hilo de zoom puede redimensionar los búferes.
+            std::unique_lock<std::mutex> zoom_lock(zoomData.mtx);
+            const std::vector<double>& shared_zoom_bars = zoomData.out_data[1 - zoomData.write_buffer_index.load()];
+            zoom_bars.assign(shared_zoom_bars.begin(), shared_zoom_bars.end());
+            zoom_lock.unlock();
+            int zoom_num_bars = static_cast<int>(zoom_bars.size());
+
+            glBegin(GL_LINE_STRIP);
+            glColor3f(base_color[0] + 0.3f, base_color[1] + 0.3f, base_color[2] + 0.3f);
+            for (int i = 0; i < zoom_num_bars; ++i) {
+                double zoom_height_normalized = zoom_bars[i] * amplitude_factor;
+                if (zoom_height_normalized > 1.0) zoom_height_normalized = 1.0;
+                if (zoom_height_normalized < 0.0) zoom_height_normalized = 0.0;
+
+                double x_position = -1.0 + (i + 0.5) * 2.0 / zoom_num_bars;
+                double y_height = ZOOM_PANEL_BOTTOM + zoom_height_normalized * (1.0 - ZOOM_PANEL_BOTTOM);
+                glVertex2f(x_position, y_height);
+            }
+            glEnd();
+        }
+
+        // Informar al planificador del tiempo usado frente al tiempo disponible para el fotograma.
+        ReportRenderTime(sharedVisualizerData.scheduler, glfwGetTime() - frame_start_time, display_period * swap_interval);
+
         // Swap front and back buffers.
         glfwSwapBuffers(window);
     }
@@ -4,5 +4,6 @@
 #include "config.h"
 
 // The main rendering thread function, now with a new parameter for shared configuration.
-void RenderThread(VisualizerData& sharedVisualizerData, SharedConfigData& sharedConfigData);
+// The zoom data is drawn as an overlay panel when the high-resolution zoom mode is active.
+void RenderThread(VisualizerData& sharedVisualizerData, ZoomData& zoomData, SharedConfigData& sharedConfigData);
 
@@ -0,0 +1,206 @@
+#include "zoom-processing.h"
+#include <iostream>
+#include <fftw3.h>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Límites del tamaño de la FFT de zoom.
+const int MIN_ZOOM_FFT_SIZE = 65536;
+const int MAX_ZOOM_FFT_SIZE = 262144;
+// Número de ejecuciones de cada plan para medir la aceleración.
+const int ZOOM_BENCHMARK_RUNS = 10;
+
+bool InitializeFFTWThreads() {
+    if (fftw_init_threads() == 0) {
+        std::cerr << "Error: No se pudo inicializar el soporte multihilo de FFTW." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void AppendZoomSamples(ZoomData& zoomData, const std::vector<double>& samples) {
+    std::unique_lock<std::mutex> lock(zoomData.mtx);
+    size_t history_size = zoomData.history.size();
+    if (history_size == 0) {
+        return;
+    }
+
+    // Copiar el bloque en el historial circular, en uno o dos tramos.
+    size_t count = std::min(samples.size(), history_size);
+    size_t first_part = std::min(count, history_size - zoomData.history_pos);
+    std::copy(samples.end() - count, samples.end() - count + first_part, zoomData.history.begin() + zoomData.history_pos);
+    std::copy(samples.end() - count + first_part, samples.end(), zoomData.history.begin());
+    zoomData.history_pos = (zoomData.history_pos + count) % history_size;
+    zoomData.has_new_samples = true;
+    lock.unlock();
+
+    zoomData.cv.notify_one();
+}
+
+// Tiempo medio (en segundos) de ejecución de un plan de FFTW.
+static double BenchmarkPlan(fftw_plan plan) {
+    fftw_execute(plan);
+    auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < ZOOM_BENCHMARK_RUNS; ++i) {
+        fftw_execute(plan);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    return elapsed.count() / ZOOM_BENCHMARK_RUNS;
+}
+
+void ZoomProcessingThread(ZoomData& zoomData, VisualizerData& sharedVisualizerData, SharedConfigData& sharedConfigData) {
+    // Obtener la configuración del modo zoom de forma segura.
+    std::unique_lock<std::mutex> config_lock(sharedConfigData.mtx);
+    const bool zoom_enabled = sharedConfigData.config.zoom_enabled;
+    const int zoom_fft_size = std::min(std::max(sharedConfigData.config.zoom_fft_size, MIN_ZOOM_FFT_SIZE), MAX_ZOOM_FFT_SIZE);
+    const double max_frequency = std::min(std::max<double>(sharedConfigData.config.zoom_max_frequency, 0.0), SAMPLE_RATE / 2.0);
+    const double min_frequency = std::min(std::max<double>(sharedConfigData.config.zoom_min_frequency, 0.0), max_frequency);
+    const int zoom_threads = std::max(sharedConfigData.config.zoom_threads, 1);
+    const bool zoom_benchmark = sharedConfigData.config.zoom_benchmark;
+    config_lock.unlock();
+
+    if (!zoom_enabled || max_frequency <= min_frequency) {
+        return;
+    }
+
+    std::cout << "Hilo de zoom iniciado (" << zoom_fft_size << " puntos, " << zoom_threads << " hilos)." << std::endl;
+
+    double* fft_in = (double*)fftw_malloc(sizeof(double) * zoom_fft_size);
+    fftw_complex* fft_out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (zoom_fft_size / 2 + 1));
+    if (fft_in == NULL || fft_out == NULL) {
+        std::cerr << "Error: No se pudo asignar memoria para la FFT de zoom." << std::endl;
+        fftw_free(fft_in);
+        fftw_free(fft_out);
+        return;
+    }
+    std::fill(fft_in, fft_in + zoom_fft_size, 0.0);
+
+    // Crear los planes. Se usa FFTW_ESTIMATE porque medir planes de este tamaño tardaría
+    // varios segundos con el mutex del planificador bloqueado, retrasando al hilo de procesamiento.
+    fftw_plan plan_threaded;
+    fftw_plan plan_single = NULL;
+    std::unique_lock<std::mutex> planner_lock(fftw_planner_mtx);
+    fftw_plan_with_nthreads(zoom_threads);
+    plan_threaded = fftw_plan_dft_r2c_1d(zoom_fft_size, fft_in, fft_out, FFTW_ESTIMATE);
+    // Restaurar un solo hilo para que los demás planes no se vean afectados.
+    fftw_plan_with_nthreads(1);
+    if (zoom_benchmark) {
+        plan_single = fftw_plan_dft_r2c_1d(zoom_fft_size, fft_in, fft_out, FFTW_ESTIMATE);
+    }
+    planner_lock.unlock();
+
+    // Medir la aceleración del plan multihilo frente al de un solo hilo.
+    if (plan_single != NULL) {
+        double single_time = BenchmarkPlan(plan_single);
+        double threaded_time = BenchmarkPlan(plan_threaded);
+        // La consola se oculta al iniciar: se guardan los tiempos para que el renderizador los muestre.
+        zoomData.benchmark_single_ms.store(single_time * 1000.0);
+        zoomData.benchmark_threaded_ms.store(threaded_time * 1000.0);
+        std::cout << "FFT de zoom: " << single_time * 1000.0 << " ms con 1 hilo, "
+            << threaded_time * 1000.0 << " ms con " << zoom_threads << " hilos (aceleración x"
+            << single_time / threaded_time << ")." << std::endl;
+
+        planner_lock.lock();
+        fftw_destroy_plan(plan_single);
+        planner_lock.unlock();
+    }
+
+    // Ventana de Hann precalculada, escalada por 2 para compensar su ganancia coherente.
+    std::vector<double> hann_window(zoom_fft_size);
+    for (int i = 0; i < zoom_fft_size; ++i) {
+        hann_window[i] = 1.0 - cos(2.0 * M_PI * i / (zoom_fft_size - 1));
+    }
+
+    // Resolución de frecuencia por bin y factor para que un tono tenga la misma altura que en la FFT normal.
+    const double bin_resolution = SAMPLE_RATE / zoom_fft_size;
+    const double magnitude_scale = static_cast<double>(FFT_SIZE) / zoom_fft_size;
+    const int max_bin = zoom_fft_size / 2;
+
+    // Copia del historial en orden cronológico, para aplicar la ventana sin el mutex bloqueado.
+    std::vector<double> history_copy(zoom_fft_size);
+    // Barras calculadas fuera del mutex; solo se copian al búfer compartido al publicarlas.
+    std::vector<double> bars;
+
+    // Preparar el historial y activar la recepción de muestras.
+    std::unique_lock<std::mutex> lock(zoomData.mtx);
+    zoomData.history.assign(zoom_fft_size, 0.0);
+    zoomData.history_pos = 0;
+    zoomData.has_new_samples = false;
+    lock.unlock();
+    zoomData.active.store(true);
+
+    while (!sharedVisualizerData.should_terminate.load()) {
+        lock.lock();
+        zoomData.cv.wait(lock, [&] { return zoomData.has_new_samples || sharedVisualizerData.should_terminate.load(); });
+
+        if (sharedVisualizerData.should_terminate.load()) {
+            break;
+        }
+        zoomData.has_new_samples = false;
+
+        // Copiar el historial en orden cronológico (desde la muestra más antigua), en dos tramos.
+        // Con el mutex bloqueado solo se hace la copia, para que el hilo de captura espere lo mínimo.
+        auto oldest = zoomData.history.begin() + zoomData.history_pos;
+        std::copy(oldest, zoomData.history.end(), history_copy.begin());
+        std::copy(zoomData.history.begin(), oldest, history_copy.begin() + (zoomData.history.end() - oldest));
+
+        lock.unlock();
+
+        // Aplicar la ventana fuera del mutex.
+        for (int i = 0; i < zoom_fft_size; ++i) {
+            fft_in[i] = history_copy[i] * hann_window[i];
+        }
+
+        fftw_execute(plan_threaded);
+
+        int num_bars = sharedVisualizerData.atomic_num_bars.load();
+        if (num_bars <= 0) {
+            continue;
+        }
+        const double frequency_per_bar = (max_frequency - min_frequency) / num_bars;
+
+        bars.resize(num_bars);
+
+        // Repartir solo la banda seleccionada entre las barras.
+        for (int i = 0; i < num_bars; ++i) {
+            int start_bin = static_cast<int>((min_frequency + i * frequency_per_bar) / bin_resolution);
+            int end_bin = static_cast<int>((min_frequency + (i + 1) * frequency_per_bar) / bin_resolution);
+
+            // Si la banda es más estrecha que el número de barras, cada barra toma al menos un bin.
+            end_bin = std::max(end_bin, start_bin + 1);
+            end_bin = std::min(end_bin, max_bin);
+
+            // Usar el pico de la barra para que los tonos aislados no se diluyan.
+            double peak_magnitude = 0.0;
+            for (int j = start_bin; j < end_bin; ++j) {
+                peak_magnitude = std::max(peak_magnitude, sqrt(fft_out[j][0] * fft_out[j][0] + fft_out[j][1] * fft_out[j][1]));
+            }
+
+            double scaled_value = 10.0 * log10(1 + peak_magnitude * magnitude_scale);
+            scaled_value = std::min(scaled_value, MAX_BAR_VALUE);
+            scaled_value = std::max(scaled_value, 0.0);
+            bars[i] = scaled_value;
+        }
+
+        // Publicar con el mutex bloqueado: el renderizador copia el otro búfer con el mismo mutex,
+        // y el cambio de tamaño no debe coincidir con su lectura.
+        lock.lock();
+        int write_index = zoomData.write_buffer_index.load();
+        zoomData.out_data[write_index].assign(bars.begin(), bars.end());
+        zoomData.write_buffer_index.store(1 - write_index);
+        lock.unlock();
+    }
+
+    zoomData.active.store(false);
+
+    planner_lock.lock();
+    fftw_destroy_plan(plan_threaded);
+    planner_lock.unlock();
+    fftw_free(fft_in);
+    fftw_free(fft_out);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "common.h"
+#include "config.h"
+
+// Inicializa el soporte multihilo de FFTW. Debe llamarse una sola vez,
+// antes de crear cualquier plan de FFTW.
+bool InitializeFFTWThreads();
+
+// Añade un bloque de audio al historial del modo zoom y despierta al hilo de zoom.
+// Lo llama el hilo de captura una vez por bloque publicado.
+void AppendZoomSamples(ZoomData& zoomData, const std::vector<double>& samples);
+
+// Función principal del hilo de zoom: FFT de gran tamaño con FFTW multihilo
+// sobre la banda de frecuencias configurada.
+void ZoomProcessingThread(ZoomData& zoomData, VisualizerData& sharedVisualizerData, SharedConfigData& sharedConfigData);